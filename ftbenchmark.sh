@@ -0,0 +1,95 @@
+#!/bin/bash
+#######################################################################
+# Name: Chelsea Egan
+# Course: CS 372-400
+# Program: ftbenchmark.sh
+# Description: Compares file transfer throughput with and without TLS
+# over the loopback interface. Builds the server, makes a self-signed
+# certificate if there isn't one and times ftclient.py fetching a
+# generated text file from each kind of server. Exits non-zero if
+# any transfer fails, or if FTBENCH_REQUIRE_KTLS=1 and the TLS runs
+# were not sent with kernel TLS.
+# Usage: ./ftbenchmark.sh [size in MB] [runs]
+# Last Modified: October 19, 2026
+#######################################################################
+
+SIZE_MB=${1:-64}
+RUNS=${2:-5}
+CONTROL_PORT=30210
+DATA_PORT=20210
+CLIENT_TIMEOUT=60
+REPO=$(cd "$(dirname "$0")" && pwd)
+HOST=$(hostname)
+WORK=$(mktemp -d)
+FAILED=0
+
+# Keep the server's directory snapshot with the rest of the scratch files
+export FTSERVER_SNAPSHOT="$WORK/ftserver.snapshot"
+
+trap 'kill $SERVER 2>/dev/null; rm -rf "$WORK"' EXIT
+
+cd "$REPO" && make ftserver > /dev/null || exit 1
+[ -f ftserver.crt ] || make certs > /dev/null 2>&1 || exit 1
+
+# Text payload, since ftclient.py saves files as text
+mkdir "$WORK/server" "$WORK/client"
+cp "$REPO/ftserver.exe" "$WORK/server"
+head -c $((SIZE_MB * 1024 * 768)) /dev/urandom | base64 -w 76 > "$WORK/server/payload.txt"
+BYTES=$(stat -c %s "$WORK/server/payload.txt")
+
+######################################################
+# Name: run_benchmark
+# Preconditions: label for the results, CA file for
+# the client (empty for plaintext), followed by
+# environment settings for the server
+# Postconditions: Starts the server, fetches the
+# payload RUNS times and prints the average throughput.
+# A fetch that hangs (e.g. the ACK after the file never
+# arrives), fails or differs from the original is
+# reported and sets FAILED
+######################################################
+run_benchmark() {
+    local label=$1
+    local ca=$2
+    shift 2
+
+    (cd "$WORK/server" && exec env "$@" ./ftserver.exe $CONTROL_PORT > "$WORK/$label.log") &
+    SERVER=$!
+    sleep 0.5
+
+    local start=$(date +%s.%N)
+    for run in $(seq 1 "$RUNS"); do
+        rm -f "$WORK/client/payload.txt"
+        if ! (cd "$WORK/client" && FTCLIENT_TLS_CA="$ca" timeout $CLIENT_TIMEOUT \
+              python3 "$REPO/ftclient.py" "$HOST" $CONTROL_PORT -g payload.txt $DATA_PORT) \
+              | grep -q "File transfer complete"; then
+            echo "$label: transfer $run did not complete"
+            FAILED=1
+        elif ! cmp -s "$WORK/server/payload.txt" "$WORK/client/payload.txt"; then
+            echo "$label: transfer $run corrupted"
+            FAILED=1
+        fi
+    done
+    local end=$(date +%s.%N)
+
+    kill $SERVER
+    wait $SERVER 2>/dev/null
+
+    # The server logs every file it sends with kernel TLS
+    local offloaded=$(grep -c "kernel TLS" "$WORK/$label.log")
+    local offload=""
+    [ "$offloaded" -eq "$RUNS" ] && offload=" (kTLS)"
+    [ "$offloaded" -gt 0 ] && [ "$offloaded" -lt "$RUNS" ] && offload=" (kTLS for $offloaded of $RUNS)"
+    if [ -n "$ca" ] && [ "$FTBENCH_REQUIRE_KTLS" = 1 ] && [ "$offloaded" -ne "$RUNS" ]; then
+        echo "$label: kernel TLS was not used for every transfer"
+        FAILED=1
+    fi
+    awk -v label="$label$offload" -v bytes="$BYTES" -v runs="$RUNS" -v start="$start" -v end="$end" \
+        'BEGIN { printf "%s: %.1f MB/s\n", label, bytes * runs / (end - start) / 1048576 }'
+}
+
+echo "Fetching $BYTES bytes $RUNS times over $HOST"
+run_benchmark plaintext "" FTSERVER_TLS_CERT=
+run_benchmark tls "$REPO/ftserver.crt" FTSERVER_TLS_CERT="$REPO/ftserver.crt" FTSERVER_TLS_KEY="$REPO/ftserver.key"
+
+exit $FAILED
@@ -7,17 +7,23 @@
 # Description: This is a client of a file transfer system. The client
 # connects to the server and then can either request the listing of the
 # server's directory or to receive a file from the directory.
+# If FTCLIENT_TLS_CA names a CA certificate, both connections are
+# encrypted with TLS and the server's certificate is checked against it.
 # Source for socket functionality: 
 # https://docs.python.org/3/library/socket.html
-# Last Modified: June 2, 2019
+# Source for TLS: https://docs.python.org/3/library/ssl.html
+# Last Modified: October 19, 2026
 #######################################################################
 
 import socket
+import ssl
 import sys
 import errno
+import os
 import os.path
 
 CONFIRMATION = 'ACK'
+TLS_CA_ENV = 'FTCLIENT_TLS_CA'
 
 ######################################################
 # Name: validate_args
@@ -83,6 +89,24 @@ def invalid_args():
     print('\nGoodbye!')
     sys.exit()
 
+######################################################
+# Name: wrap_tls
+# Preconditions: a connected socket to the server
+# Postconditions: If TLS_CA_ENV is set, performs the
+# client side of a TLS handshake over the socket and
+# returns the encrypted socket. The server acts as the
+# TLS server on both connections, even the data
+# connection it opens. Otherwise returns the socket
+# unchanged.
+######################################################
+def wrap_tls(plain_socket):
+    ca_file = os.environ.get(TLS_CA_ENV)
+    if not ca_file:
+        return plain_socket
+
+    context = ssl.create_default_context(cafile=ca_file)
+    return context.wrap_socket(plain_socket, server_hostname=sys.argv[1])
+
 ######################################################
 # Name: initiate_contact
 # Preconditions: User entered a string and a number in
@@ -102,7 +126,7 @@ def initiate_contact():
         control_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         # Make connection with server passing hostname and port
         control_socket.connect((hostname, port))
-        return control_socket
+        return wrap_tls(control_socket)
     except:
         print('\nError creating control socket\n')
         raise
@@ -350,6 +374,7 @@ def make_request(control_socket, command_type):
         # Let server know client is ready for connection
         control_socket.send(CONFIRMATION.encode())
         data_socket, addr = welcome_socket.accept()
+        data_socket = wrap_tls(data_socket)
 
         # Get response for server based on command
         if command_type == 4:
@@ -0,0 +1,271 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: fthandoff.c
+ * Description: This file provides the hot upgrade used by
+ * ftserver.c. On HANDOFF_SIGNAL the running server execs a fresh
+ * copy of its binary and passes it the welcoming socket over a
+ * Unix socket, so new clients are never refused while the old
+ * server finishes its session and exits.
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ftutilities.h"
+#include "fthandoff.h"
+
+static volatile sig_atomic_t upgradeRequested = 0;
+
+// Channel to the server being replaced, open until the takeover is confirmed
+static int handoffChannel = -1;
+
+/*****************************************************************
+ * Name: catchHandoffSignal
+ * Preconditions:
+ * @param signalNumber - number of the signal that was caught
+ * Postconditions: Records that a hot upgrade was requested. The
+ * main loop performs it once it is between clients.
+ *****************************************************************/
+static void catchHandoffSignal(int signalNumber) {
+    (void)signalNumber;
+    upgradeRequested = 1;
+}
+
+/*****************************************************************
+ * Name: initHandoffSignal
+ * Preconditions:
+ * @param waitMask - where the signal mask used while waiting for
+ * connections is stored
+ * Postconditions: Installs the HANDOFF_SIGNAL handler and blocks
+ * the signal, so it is only delivered while waiting in
+ * waitForConnection and never interrupts a transfer.
+ * Source: https://man7.org/linux/man-pages/man2/ppoll.2.html
+ *****************************************************************/
+void initHandoffSignal(sigset_t *waitMask) {
+    struct sigaction action;
+    sigset_t handoffMask;
+
+    memset(&action, 0, sizeof action);
+    action.sa_handler = catchHandoffSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(HANDOFF_SIGNAL, &action, NULL);
+
+    // Block the signal everywhere except inside ppoll
+    sigemptyset(&handoffMask);
+    sigaddset(&handoffMask, HANDOFF_SIGNAL);
+    sigprocmask(SIG_BLOCK, &handoffMask, waitMask);
+    sigdelset(waitMask, HANDOFF_SIGNAL);
+}
+
+/*****************************************************************
+ * Name: handoffRequested
+ * Postconditions: Returns true (and clears the request) if
+ * HANDOFF_SIGNAL was received since the last call.
+ *****************************************************************/
+bool handoffRequested(void) {
+    if(upgradeRequested) {
+        upgradeRequested = 0;
+        return true;
+    }
+    return false;
+}
+
+/*****************************************************************
+ * Name: waitForConnection
+ * Preconditions:
+ * @param sockets - array of sockets used by program
+ * @param waitMask - signal mask from initHandoffSignal
+ * Postconditions: Blocks until a client is waiting on the
+ * welcoming socket and returns 0. Returns -1 if interrupted by a
+ * signal so the caller can check handoffRequested.
+ *****************************************************************/
+int waitForConnection(int sockets[], sigset_t *waitMask) {
+    struct pollfd welcome = {sockets[WELCOME_SOCKET], POLLIN, 0};
+
+    if(ppoll(&welcome, 1, NULL, waitMask) == -1) {
+        if(errno != EINTR) {
+            terminateProgram("FAILED TO WAIT FOR CONNECTIONS", sockets);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*****************************************************************
+ * Name: receiveHandoff
+ * Preconditions:
+ * @param sockets - array of sockets used by program
+ * Postconditions: If this server was started by performHandoff,
+ * receives the old server's welcoming socket and stores it in
+ * sockets. The old server keeps serving until confirmHandoff is
+ * called. Returns -1 if this is a normal start (or the handoff
+ * failed) and a new welcoming socket must be created instead.
+ * Source: https://man7.org/linux/man-pages/man7/unix.7.html
+ *****************************************************************/
+int receiveHandoff(int sockets[]) {
+    int channel;
+    char *channelName = getenv(HANDOFF_ENV);
+    char oldServer[MAXBUFFERSIZE] = {0};
+    struct iovec payload = {oldServer, sizeof(oldServer) - 1};
+    struct msghdr message;
+    struct cmsghdr *rights;
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    if(channelName == NULL) {
+        return -1;
+    }
+    channel = atoi(channelName);
+    unsetenv(HANDOFF_ENV);
+
+    memset(&message, 0, sizeof message);
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    // Old server sends its pid along with the welcoming socket
+    if(recvmsg(channel, &message, 0) <= 0) {
+        close(channel);
+        return -1;
+    }
+
+    // A truncated message may not hold the whole descriptor
+    rights = CMSG_FIRSTHDR(&message);
+    if((message.msg_flags & MSG_CTRUNC) || rights == NULL || rights->cmsg_level != SOL_SOCKET
+       || rights->cmsg_type != SCM_RIGHTS || rights->cmsg_len != CMSG_LEN(sizeof(int))) {
+        close(channel);
+        return -1;
+    }
+    memcpy(&sockets[WELCOME_SOCKET], CMSG_DATA(rights), sizeof(int));
+    handoffChannel = channel;
+
+    fflush(stdout);
+    printf("\nReceived listening socket from server %s\n", oldServer);
+    return 0;
+}
+
+/*****************************************************************
+ * Name: confirmHandoff
+ * Preconditions:
+ * @param sockets - array of sockets used by program
+ * Postconditions: If a welcoming socket was received, tells the
+ * old server it can stop accepting connections. Must be called
+ * once everything else that can fail during startup has
+ * succeeded, since the old server exits as soon as it is told.
+ * Terminates the program if the old server can't be told, as it
+ * has already given up and is still serving.
+ *****************************************************************/
+void confirmHandoff(int sockets[]) {
+    if(handoffChannel == -1) {
+        return;
+    }
+
+    if(send(handoffChannel, CONFIRMATION, strlen(CONFIRMATION), MSG_NOSIGNAL) == -1) {
+        close(handoffChannel);
+        handoffChannel = -1;
+        terminateProgram("OLD SERVER DID NOT WAIT FOR TAKEOVER", sockets);
+    }
+    close(handoffChannel);
+    handoffChannel = -1;
+
+    fflush(stdout);
+    printf("Took over from old server\n\n");
+}
+
+/*****************************************************************
+ * Name: performHandoff
+ * Preconditions:
+ * @param argv - command line the server was started with
+ * @param sockets - array of sockets used by program
+ * Postconditions: Execs a new copy of the server and passes it
+ * the welcoming socket with SCM_RIGHTS. Returns 0 once the new
+ * server has confirmed the takeover and this one should exit.
+ * Returns -1 if the upgrade failed and this server should keep
+ * accepting connections.
+ * Source: https://man7.org/linux/man-pages/man3/cmsg.3.html
+ *****************************************************************/
+int performHandoff(char *argv[], int sockets[]) {
+    int channels[2];
+    char channelName[16];
+    char pid[16];
+    char confirmation[MAXBUFFERSIZE + 1] = {0};
+    struct timeval timeout = {HANDOFF_TIMEOUT, 0};
+    struct iovec payload;
+    struct msghdr message;
+    struct cmsghdr *rights;
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    fflush(stdout);
+    printf("\nHot upgrade requested, starting new server\n");
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, channels) == -1) {
+        printf("Failed to create handoff channel\n");
+        return -1;
+    }
+
+    switch(fork()) {
+        case -1:
+            close(channels[0]);
+            close(channels[1]);
+            printf("Failed to start new server\n");
+            return -1;
+        case 0:
+            // The welcoming socket is passed over the channel, not inherited
+            close(channels[0]);
+            close(sockets[WELCOME_SOCKET]);
+            snprintf(channelName, sizeof(channelName), "%d", channels[1]);
+            setenv(HANDOFF_ENV, channelName, 1);
+            execvp(argv[0], argv);
+            _exit(1);
+    }
+    close(channels[1]);
+
+    // Send the welcoming socket along with this server's pid
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    payload.iov_base = pid;
+    payload.iov_len = strlen(pid);
+
+    memset(&message, 0, sizeof message);
+    memset(&control, 0, sizeof control);
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    rights = CMSG_FIRSTHDR(&message);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(rights), &sockets[WELCOME_SOCKET], sizeof(int));
+
+    // Keep serving if the new server never confirms
+    setsockopt(channels[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if(sendmsg(channels[0], &message, 0) == -1
+       || receiveMessage(&channels[0], confirmation) == -1
+       || strcmp(confirmation, CONFIRMATION) != 0) {
+        close(channels[0]);
+        printf("New server did not take over, continuing to serve\n");
+        return -1;
+    }
+    close(channels[0]);
+
+    printf("New server took over, exiting\n");
+    return 0;
+}
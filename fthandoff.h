@@ -0,0 +1,27 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: fthandoff.h
+ * Description: This file provides the declaration of functions
+ * used by fthandoff.c
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#ifndef PROJECT_2_FTHANDOFF_H
+#define PROJECT_2_FTHANDOFF_H
+
+#include <signal.h>
+#include <stdbool.h>
+
+#define HANDOFF_ENV "FTSERVER_HANDOFF_FD"   // Names the Unix socket inherited by the new server
+#define HANDOFF_SIGNAL SIGUSR2              // Signal that starts a hot upgrade
+#define HANDOFF_TIMEOUT 10                  // Seconds to wait for the new server to take over
+
+void initHandoffSignal(sigset_t *);
+bool handoffRequested(void);
+int waitForConnection(int[], sigset_t *);
+int receiveHandoff(int[]);
+void confirmHandoff(int[]);
+int performHandoff(char *[], int[]);
+
+#endif //PROJECT_2_FTHANDOFF_H
@@ -6,7 +6,9 @@
  * opens a connection for clients and, once a request is received,
  * connects to a control socket. It gets commands from the client
  * and sends the response over a separate data connection.
- * Last Modified: June 2, 2019
+ * Sending SIGUSR2 hands the listening socket to a freshly started
+ * copy of the server (hot upgrade).
+ * Last Modified: October 19, 2026
 *****************************************************************/
 #include <stdbool.h>
 #include <stdio.h>
@@ -14,18 +16,31 @@
 #include <unistd.h>
 
 #include "ftutilities.h"
+#include "fthandoff.h"
 
 int main(int argc, char *argv[]) {
     int welcomeSocket, controlSocket, dataSocket;
     int sockets[] = {welcomeSocket, controlSocket, dataSocket};
     char clientHostName[MAXBUFFERSIZE] = {0};
     char *controlPort = argv[1];
+    sigset_t waitMask;
+
+    // Only accept hot upgrade requests between clients
+    initHandoffSignal(&waitMask);
 
     // Create welcoming socket
     startUp(argc, controlPort, sockets);
 
-    // Run until program is terminated
+    // Run until program is terminated or replaced
     while(1) {
+        // Wait for a client, handing off to a new server if requested
+        if(waitForConnection(sockets, &waitMask) == -1) {
+            if(handoffRequested() && performHandoff(argv, sockets) == 0) {
+                break;
+            }
+            continue;
+        }
+
         // Listen for connection requests
         acceptConnections(sockets, clientHostName);
 
@@ -33,5 +48,6 @@ int main(int argc, char *argv[]) {
         handleRequests(sockets, clientHostName);
     }
 
+    close(sockets[WELCOME_SOCKET]);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,554 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: ftsnapshot.c
+ * Description: This file provides the directory snapshot used by
+ * ftutilities.c. The names in the served directory are kept in a
+ * sorted binary file that is mmap'd on startup, so a restarted
+ * server can answer listings and lookups without rescanning. The
+ * snapshot is checked against the directory's mtime when a request
+ * needs it. Large directories are rescanned by a child process
+ * while the old snapshot keeps being served.
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ftsnapshot.h"
+
+static char snapshotPath[PATH_MAX];
+static char *image = NULL;
+static size_t imageSize = 0;
+static bool imageMapped = false;
+static dev_t mappedDevice = 0;
+static ino_t mappedInode = 0;
+static bool imageCorrupt = false;
+static bool imageStale = false;
+static pid_t rebuildPid = -1;
+
+static const struct SnapshotHeader *header = NULL;
+static const struct SnapshotEntry *entries = NULL;
+static const char *names = NULL;
+
+/*****************************************************************
+ * Name: releaseImage
+ * Preconditions:
+ * @param oldImage - snapshot image to release
+ * @param size - size of the image in bytes
+ * @param mapped - true if the image was mmap'd, false if malloc'd
+ * Postconditions: Unmaps or frees the image.
+ *****************************************************************/
+static void releaseImage(char *oldImage, size_t size, bool mapped) {
+    if(oldImage == NULL) {
+        return;
+    }
+    if(mapped) {
+        munmap(oldImage, size);
+    } else {
+        free(oldImage);
+    }
+}
+
+/*****************************************************************
+ * Name: useImage
+ * Preconditions:
+ * @param newImage - snapshot image to start serving from
+ * @param size - size of the image in bytes
+ * @param mapped - true if the image was mmap'd, false if malloc'd
+ * Postconditions: Checks that the image is a well formed snapshot
+ * and, if so, replaces the current one with it and returns 0.
+ * Otherwise releases the image and returns -1. Only the header is
+ * checked so that huge snapshots are not read in at startup;
+ * entries are bounds checked as they are used.
+ *****************************************************************/
+static int useImage(char *newImage, size_t size, bool mapped) {
+    const struct SnapshotHeader *newHeader = (const struct SnapshotHeader *)newImage;
+    uint64_t namesStart;
+
+    if(size < sizeof(struct SnapshotHeader)
+       || memcmp(newHeader->magic, SNAPSHOT_MAGIC, sizeof(newHeader->magic)) != 0
+       || newHeader->version != SNAPSHOT_VERSION) {
+        releaseImage(newImage, size, mapped);
+        return -1;
+    }
+
+    // Sections must exactly fill the file and names must be terminated
+    namesStart = sizeof(struct SnapshotHeader)
+                 + (uint64_t)newHeader->entryCount * sizeof(struct SnapshotEntry);
+    if(namesStart + newHeader->namesSize != size
+       || (newHeader->entryCount > 0 && newHeader->namesSize == 0)
+       || (newHeader->namesSize > 0 && newImage[size - 1] != '\0')) {
+        releaseImage(newImage, size, mapped);
+        return -1;
+    }
+
+    releaseImage(image, imageSize, imageMapped);
+    image = newImage;
+    imageSize = size;
+    imageMapped = mapped;
+
+    header = newHeader;
+    entries = (const struct SnapshotEntry *)(image + sizeof(struct SnapshotHeader));
+    names = image + namesStart;
+    imageCorrupt = false;
+    return 0;
+}
+
+/*****************************************************************
+ * Name: mapSnapshot
+ * Postconditions: Maps the snapshot file read-only and starts
+ * serving from it. Returns -1 if there is no usable snapshot.
+ * Source: https://man7.org/linux/man-pages/man2/mmap.2.html
+ *****************************************************************/
+static int mapSnapshot(void) {
+    int fd;
+    struct stat fileStats;
+    char *newImage;
+
+    if(snapshotPath[0] == '\0' || (fd = open(snapshotPath, O_RDONLY | O_NOFOLLOW)) == -1) {
+        return -1;
+    }
+    if(fstat(fd, &fileStats) == -1 || !S_ISREG(fileStats.st_mode) || fileStats.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+
+    newImage = mmap(NULL, fileStats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(newImage == MAP_FAILED || useImage(newImage, fileStats.st_size, true) == -1) {
+        return -1;
+    }
+
+    // Remember which file is mapped to notice when it is replaced
+    mappedDevice = fileStats.st_dev;
+    mappedInode = fileStats.st_ino;
+    return 0;
+}
+
+/*****************************************************************
+ * Name: writeSnapshot
+ * Preconditions:
+ * @param newImage - snapshot image to be saved
+ * @param size - size of the image in bytes
+ * Postconditions: Writes the image to a new temporary file and
+ * renames it over the snapshot, so a reader never sees a partial
+ * file. Returns -1 if the snapshot could not be saved.
+ *****************************************************************/
+static int writeSnapshot(const char *newImage, size_t size) {
+    int fd;
+    ssize_t written;
+    size_t total = 0;
+    char tempPath[PATH_MAX + 16];
+
+    if(snapshotPath[0] == '\0') {
+        return -1;
+    }
+
+    // mkstemp never reuses or follows an existing file
+    snprintf(tempPath, sizeof(tempPath), "%s.XXXXXX", snapshotPath);
+    if((fd = mkstemp(tempPath)) == -1) {
+        return -1;
+    }
+
+    while(total < size) {
+        if((written = write(fd, newImage + total, size - total)) == -1) {
+            close(fd);
+            unlink(tempPath);
+            return -1;
+        }
+        total += written;
+    }
+
+    if(fsync(fd) == -1 || close(fd) == -1 || rename(tempPath, snapshotPath) == -1) {
+        unlink(tempPath);
+        return -1;
+    }
+    return 0;
+}
+
+/*****************************************************************
+ * Name: compareNames
+ * Preconditions:
+ * @param first - pointer to the first name
+ * @param second - pointer to the second name
+ * Postconditions: qsort comparator ordering names with strcmp.
+ *****************************************************************/
+static int compareNames(const void *first, const void *second) {
+    return strcmp(*(char * const *)first, *(char * const *)second);
+}
+
+/*****************************************************************
+ * Name: buildSnapshot
+ * Preconditions:
+ * @param dirStats - stat of the directory taken before scanning
+ * Postconditions: Scans the directory, saves a new snapshot and
+ * starts serving from it. If the snapshot cannot be saved the
+ * image is served from memory instead. Returns -1 if the directory
+ * could not be read.
+ * Source: https://stackoverflow.com/a/22623744
+ *****************************************************************/
+static int buildSnapshot(const struct stat *dirStats) {
+    DIR *directory;
+    struct dirent *dirPtr;
+    char **dirNames = NULL;
+    char **grown;
+    uint32_t count = 0, capacity = 0, i;
+    uint64_t namesSize = 0, namesStart, offset;
+    size_t size;
+    char *newImage;
+    struct SnapshotHeader *newHeader;
+    struct SnapshotEntry *newEntries;
+
+    if((directory = opendir(".")) == NULL) {
+        return -1;
+    }
+
+    // Collect every name in the directory
+    while((dirPtr = readdir(directory)) != NULL) {
+        if(count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            if((grown = realloc(dirNames, capacity * sizeof(char *))) == NULL) {
+                break;
+            }
+            dirNames = grown;
+        }
+        if((dirNames[count] = strdup(dirPtr->d_name)) == NULL) {
+            break;
+        }
+        namesSize += strlen(dirPtr->d_name) + 1;
+        count++;
+    }
+    closedir(directory);
+
+    // Ran out of memory part way through the directory
+    if(dirPtr != NULL) {
+        for(i = 0; i < count; i++) {
+            free(dirNames[i]);
+        }
+        free(dirNames);
+        return -1;
+    }
+
+    qsort(dirNames, count, sizeof(char *), compareNames);
+
+    // Lay out header, entries and names in one image
+    namesStart = sizeof(struct SnapshotHeader) + (uint64_t)count * sizeof(struct SnapshotEntry);
+    size = namesStart + namesSize;
+    if((newImage = calloc(1, size)) == NULL) {
+        for(i = 0; i < count; i++) {
+            free(dirNames[i]);
+        }
+        free(dirNames);
+        return -1;
+    }
+
+    newHeader = (struct SnapshotHeader *)newImage;
+    memcpy(newHeader->magic, SNAPSHOT_MAGIC, sizeof(newHeader->magic));
+    newHeader->version = SNAPSHOT_VERSION;
+    newHeader->entryCount = count;
+    newHeader->dirDevice = dirStats->st_dev;
+    newHeader->dirInode = dirStats->st_ino;
+    newHeader->dirMtimeSec = dirStats->st_mtim.tv_sec;
+    newHeader->dirMtimeNsec = dirStats->st_mtim.tv_nsec;
+    newHeader->namesSize = namesSize;
+
+    newEntries = (struct SnapshotEntry *)(newImage + sizeof(struct SnapshotHeader));
+    for(i = 0, offset = 0; i < count; i++) {
+        newEntries[i].nameOffset = offset;
+        strcpy(newImage + namesStart + offset, dirNames[i]);
+        offset += strlen(dirNames[i]) + 1;
+        free(dirNames[i]);
+    }
+    free(dirNames);
+
+    // Serve from the saved file so the page cache is shared with future runs
+    if(writeSnapshot(newImage, size) == 0 && mapSnapshot() == 0) {
+        free(newImage);
+    } else if(useImage(newImage, size, false) == -1) {
+        return -1;
+    }
+
+    fflush(stdout);
+    printf("Directory snapshot rebuilt with %u entries\n", count);
+    return 0;
+}
+
+/*****************************************************************
+ * Name: isCurrent
+ * Preconditions:
+ * @param dirStats - current stat of the served directory
+ * Postconditions: Returns true if the snapshot was taken of this
+ * directory and it has not changed since.
+ *****************************************************************/
+static bool isCurrent(const struct stat *dirStats) {
+    return header != NULL
+           && header->dirDevice == (uint64_t)dirStats->st_dev
+           && header->dirInode == (uint64_t)dirStats->st_ino
+           && header->dirMtimeSec == dirStats->st_mtim.tv_sec
+           && header->dirMtimeNsec == dirStats->st_mtim.tv_nsec;
+}
+
+/*****************************************************************
+ * Name: openSnapshotDir
+ * Preconditions:
+ * @param snapshotDir - where the directory's path is stored
+ * @param size - size of snapshotDir
+ * Postconditions: Creates SNAPSHOT_DIR in the home directory if
+ * needed. Returns -1 unless it is a real directory owned by this
+ * user that nobody else can access, since a snapshot someone else
+ * could write would decide which files are served.
+ *****************************************************************/
+static int openSnapshotDir(char *snapshotDir, size_t size) {
+    struct stat dirStats;
+    char *home = getenv("HOME");
+
+    if(home == NULL || home[0] == '\0') {
+        return -1;
+    }
+    snprintf(snapshotDir, size, "%s/%s", home, SNAPSHOT_DIR);
+    mkdir(snapshotDir, 0700);
+
+    if(lstat(snapshotDir, &dirStats) == -1 || !S_ISDIR(dirStats.st_mode)
+       || dirStats.st_uid != geteuid() || (dirStats.st_mode & 077) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*****************************************************************
+ * Name: loadSnapshot
+ * Postconditions: Maps the saved snapshot of the served directory,
+ * if there is one. The snapshot is stored in SNAPSHOT_DIR (or the
+ * path in SNAPSHOT_ENV) and is not rebuilt here; an out of date
+ * snapshot is served until a request triggers a rebuild.
+ *****************************************************************/
+void loadSnapshot(void) {
+    struct stat dirStats;
+    char snapshotDir[PATH_MAX];
+    char *path = getenv(SNAPSHOT_ENV);
+
+    if(stat(".", &dirStats) == -1) {
+        return;
+    }
+
+    // Name the snapshot after the directory so servers don't share one
+    fflush(stdout);
+    if(path != NULL && path[0] != '\0') {
+        snprintf(snapshotPath, sizeof(snapshotPath), "%s", path);
+    } else if(openSnapshotDir(snapshotDir, sizeof(snapshotDir)) == -1
+              || snprintf(snapshotPath, sizeof(snapshotPath), "%s/ftserver-%llx-%llx.snapshot", snapshotDir,
+                          (unsigned long long)dirStats.st_dev, (unsigned long long)dirStats.st_ino)
+                 >= (int)sizeof(snapshotPath)) {
+        snapshotPath[0] = '\0';
+        printf("No private directory for the snapshot, keeping it in memory only\n");
+        return;
+    }
+
+    if(mapSnapshot() == -1) {
+        printf("No directory snapshot at %s\n", snapshotPath);
+    } else if(isCurrent(&dirStats)) {
+        printf("Loaded directory snapshot with %u entries\n", header->entryCount);
+    } else {
+        printf("Directory snapshot is out of date, rebuilding when first needed\n");
+    }
+}
+
+/*****************************************************************
+ * Name: rebuilding
+ * Postconditions: Returns true while a background rebuild started
+ * by refreshSnapshot is still running. Finished children are
+ * reaped automatically since SIGCHLD is ignored.
+ *****************************************************************/
+static bool rebuilding(void) {
+    if(rebuildPid != -1 && waitpid(rebuildPid, NULL, WNOHANG) == 0) {
+        return true;
+    }
+    rebuildPid = -1;
+    return false;
+}
+
+/*****************************************************************
+ * Name: snapshotReplaced
+ * Postconditions: Returns true if the snapshot file is not the one
+ * currently mapped, i.e. a background rebuild has saved a new one.
+ *****************************************************************/
+static bool snapshotReplaced(void) {
+    struct stat fileStats;
+
+    if(snapshotPath[0] == '\0' || stat(snapshotPath, &fileStats) == -1) {
+        return false;
+    }
+    return !imageMapped || fileStats.st_dev != mappedDevice || fileStats.st_ino != mappedInode;
+}
+
+/*****************************************************************
+ * Name: closeInheritedDescriptors
+ * Postconditions: Closes everything but stdin, stdout and stderr,
+ * so a rebuild child doesn't keep the welcoming socket or a
+ * client's connections open while it rescans.
+ *****************************************************************/
+static void closeInheritedDescriptors(void) {
+    long fd, maxFd;
+
+    if(close_range(3, ~0U, 0) == 0) {
+        return;
+    }
+
+    // Kernels before 5.9 have no close_range
+    maxFd = sysconf(_SC_OPEN_MAX);
+    for(fd = 3; fd < (maxFd > 0 ? maxFd : 1024); fd++) {
+        close(fd);
+    }
+}
+
+/*****************************************************************
+ * Name: refreshSnapshot
+ * Postconditions: Brings the snapshot up to date if the directory
+ * changed since it was taken. Small directories (and the very
+ * first scan) are rescanned right away. Large directories are
+ * rescanned by a child process, and the old snapshot keeps being
+ * served until the child has saved the new one. Returns 0 if the
+ * snapshot can be used and -1 if the directory could not be read.
+ *****************************************************************/
+int refreshSnapshot(void) {
+    struct stat dirStats;
+    pid_t child;
+
+    if(stat(".", &dirStats) == -1) {
+        return -1;
+    }
+    if(isCurrent(&dirStats) && !imageCorrupt) {
+        imageStale = false;
+        return 0;
+    }
+
+    // Pick up a snapshot saved by a background rebuild
+    if(snapshotReplaced() && mapSnapshot() == 0 && isCurrent(&dirStats)) {
+        imageStale = false;
+        return 0;
+    }
+
+    // Nothing usable to serve meanwhile, or cheap enough to do now
+    if(header == NULL || imageCorrupt || snapshotPath[0] == '\0'
+       || header->entryCount < SNAPSHOT_SYNC_LIMIT) {
+        imageStale = false;
+        return buildSnapshot(&dirStats);
+    }
+
+    if(!rebuilding()) {
+        fflush(stdout);
+        if((child = fork()) == 0) {
+            closeInheritedDescriptors();
+            buildSnapshot(&dirStats);
+            fflush(stdout);
+            _exit(0);
+        }
+        if(child == -1) {
+            imageStale = false;
+            return buildSnapshot(&dirStats);
+        }
+        rebuildPid = child;
+        printf("Directory changed, rebuilding snapshot in the background\n");
+    }
+
+    // Serve the old snapshot until the rebuild is done
+    imageStale = true;
+    return 0;
+}
+
+/*****************************************************************
+ * Name: snapshotEntryCount
+ * Postconditions: Returns the number of names in the snapshot.
+ *****************************************************************/
+uint32_t snapshotEntryCount(void) {
+    return header == NULL ? 0 : header->entryCount;
+}
+
+/*****************************************************************
+ * Name: entryAt
+ * Preconditions:
+ * @param index - position of the name in sorted order
+ * Postconditions: Returns the name at index, or NULL if the index
+ * or the entry's offset is out of range.
+ *****************************************************************/
+static const char* entryAt(uint32_t index) {
+    if(index >= snapshotEntryCount() || entries[index].nameOffset >= header->namesSize) {
+        return NULL;
+    }
+    return names + entries[index].nameOffset;
+}
+
+/*****************************************************************
+ * Name: snapshotEntryName
+ * Preconditions:
+ * @param index - position of the name in sorted order
+ * Postconditions: Returns the name at index, or NULL if the index
+ * is out of range or the entry is not a plain name that sorts
+ * after the one before it. Such a snapshot is marked corrupt and
+ * rebuilt by the next refreshSnapshot.
+ *****************************************************************/
+const char* snapshotEntryName(uint32_t index) {
+    const char *name = entryAt(index);
+    const char *previous;
+
+    if(name == NULL) {
+        if(index < snapshotEntryCount()) {
+            imageCorrupt = true;
+        }
+        return NULL;
+    }
+
+    if(strchr(name, '/') != NULL
+       || (index > 0 && ((previous = entryAt(index - 1)) == NULL || strcmp(previous, name) >= 0))) {
+        imageCorrupt = true;
+        return NULL;
+    }
+    return name;
+}
+
+/*****************************************************************
+ * Name: snapshotContains
+ * Preconditions:
+ * @param fileName - name to look up
+ * Postconditions: Binary searches the snapshot and returns true if
+ * the directory holds fileName. If the snapshot is out of date or
+ * damaged, a miss is checked with lstat so files added since the
+ * last scan can still be fetched. fileName must be a plain name
+ * (no '/').
+ *****************************************************************/
+bool snapshotContains(const char *fileName) {
+    uint32_t low = 0, high = snapshotEntryCount(), middle;
+    const char *name;
+    int order;
+    struct stat fileStats;
+
+    while(low < high) {
+        middle = low + (high - low) / 2;
+        if((name = snapshotEntryName(middle)) == NULL) {
+            break;
+        }
+        if((order = strcmp(fileName, name)) == 0) {
+            return true;
+        }
+        if(order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    // The snapshot can't be trusted to rule the file out
+    return (imageStale || imageCorrupt) && strchr(fileName, '/') == NULL
+           && lstat(fileName, &fileStats) == 0;
+}
@@ -0,0 +1,46 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: ftsnapshot.h
+ * Description: This file provides the declaration of functions
+ * and the on-disk format used by ftsnapshot.c
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#ifndef PROJECT_2_FTSNAPSHOT_H
+#define PROJECT_2_FTSNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SNAPSHOT_ENV "FTSERVER_SNAPSHOT"    // Overrides where the snapshot is stored
+#define SNAPSHOT_DIR ".ftserver"            // Default location, a private directory in $HOME
+#define SNAPSHOT_SYNC_LIMIT 4096            // Smaller directories are rescanned during the request
+#define SNAPSHOT_MAGIC "FTSNAP1"            // Identifies a snapshot file
+#define SNAPSHOT_VERSION 1                  // Bumped whenever the layout changes
+
+// Snapshot file layout: header, entries sorted by name, then the
+// NUL-terminated names the entries point into. Only names are kept;
+// sizes and times are still read from the file when it is sent.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t dirDevice;         // Identity and mtime of the directory
+    uint64_t dirInode;          // when it was scanned
+    int64_t dirMtimeSec;
+    int64_t dirMtimeNsec;
+    uint64_t namesSize;
+};
+
+struct SnapshotEntry {
+    uint64_t nameOffset;        // Offset into the names section
+};
+
+void loadSnapshot(void);
+int refreshSnapshot(void);
+bool snapshotContains(const char *);
+uint32_t snapshotEntryCount(void);
+const char* snapshotEntryName(uint32_t);
+
+#endif //PROJECT_2_FTSNAPSHOT_H
@@ -0,0 +1,254 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: fttls.c
+ * Description: This file provides the TLS support used by
+ * ftutilities.c. When a certificate is configured, the control and
+ * data connections are encrypted with OpenSSL. Kernel TLS (kTLS)
+ * is requested so that files can still be sent with sendfile and
+ * encrypted by the kernel instead of being copied through OpenSSL.
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include "ftutilities.h"
+#include "fttls.h"
+
+static SSL_CTX *context = NULL;
+
+// At most the control and data connections are encrypted at once
+static SSL *sessions[2] = {NULL};
+
+/*****************************************************************
+ * Name: findSession
+ * Preconditions:
+ * @param socket - socket that may be encrypted
+ * Postconditions: Returns the TLS session running over socket, or
+ * NULL if the socket is plaintext.
+ *****************************************************************/
+static SSL* findSession(int socket) {
+    size_t i;
+
+    for(i = 0; i < sizeof(sessions) / sizeof(sessions[0]); i++) {
+        if(sessions[i] != NULL && SSL_get_fd(sessions[i]) == socket) {
+            return sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/*****************************************************************
+ * Name: initTls
+ * Preconditions:
+ * @param sockets - array of sockets used by program
+ * Postconditions: If TLS_CERT_ENV names a certificate, loads it
+ * and its key (TLS_KEY_ENV, or the same file) and turns on TLS for
+ * every connection. Terminates the program if they can't be used.
+ * Source: https://www.openssl.org/docs/man3.0/man3/SSL_CTX_new.html
+ *****************************************************************/
+void initTls(int sockets[]) {
+    char *certificate = getenv(TLS_CERT_ENV);
+    char *key = getenv(TLS_KEY_ENV);
+
+    if(certificate == NULL || certificate[0] == '\0') {
+        return;
+    }
+    if(key == NULL || key[0] == '\0') {
+        key = certificate;
+    }
+
+    if((context = SSL_CTX_new(TLS_server_method())) == NULL) {
+        terminateProgram("FAILED TO CREATE TLS CONTEXT", sockets);
+    }
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+
+    // Let the kernel take over encryption after the handshake
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+#endif
+
+    if(SSL_CTX_use_certificate_chain_file(context, certificate) != 1
+       || SSL_CTX_use_PrivateKey_file(context, key, SSL_FILETYPE_PEM) != 1
+       || SSL_CTX_check_private_key(context) != 1) {
+        terminateProgram("FAILED TO LOAD TLS CERTIFICATE", sockets);
+    }
+
+    // A client dropping out of a handshake must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    fflush(stdout);
+    printf("TLS enabled with certificate %s\n", certificate);
+}
+
+/*****************************************************************
+ * Name: startTls
+ * Preconditions:
+ * @param socket - connected socket to the client
+ * Postconditions: If TLS is enabled, performs the server side of
+ * the handshake over socket (for the data connection too, even
+ * though the server opened it). Returns -1 if the handshake fails.
+ *****************************************************************/
+int startTls(int socket) {
+    size_t i;
+    SSL *ssl;
+
+    if(context == NULL) {
+        return 0;
+    }
+
+    for(i = 0; i < sizeof(sessions) / sizeof(sessions[0]) && sessions[i] != NULL; i++);
+    if(i == sizeof(sessions) / sizeof(sessions[0])) {
+        return -1;
+    }
+
+    if((ssl = SSL_new(context)) == NULL) {
+        return -1;
+    }
+    if(SSL_set_fd(ssl, socket) != 1 || SSL_accept(ssl) != 1) {
+        ERR_clear_error();
+        SSL_free(ssl);
+        return -1;
+    }
+
+    sessions[i] = ssl;
+    return 0;
+}
+
+/*****************************************************************
+ * Name: endTls
+ * Preconditions:
+ * @param socket - socket about to be closed
+ * Postconditions: Sends the TLS close notification and frees the
+ * session running over socket, if there is one.
+ *****************************************************************/
+void endTls(int socket) {
+    size_t i;
+
+    for(i = 0; i < sizeof(sessions) / sizeof(sessions[0]); i++) {
+        if(sessions[i] != NULL && SSL_get_fd(sessions[i]) == socket) {
+            SSL_shutdown(sessions[i]);
+            SSL_free(sessions[i]);
+            sessions[i] = NULL;
+            ERR_clear_error();
+        }
+    }
+}
+
+/*****************************************************************
+ * Name: tlsOffloaded
+ * Preconditions:
+ * @param socket - connected socket to the client
+ * Postconditions: Returns true if socket is encrypted and the
+ * kernel is doing the encryption of data sent over it.
+ *****************************************************************/
+bool tlsOffloaded(int socket) {
+    SSL *ssl = findSession(socket);
+
+    return ssl != NULL && BIO_get_ktls_send(SSL_get_wbio(ssl));
+}
+
+/*****************************************************************
+ * Name: tlsSend
+ * Preconditions:
+ * @param socket - connected socket to the client
+ * @param buffer - bytes to be sent
+ * @param length - number of bytes to be sent
+ * Postconditions: Sends buffer over socket, encrypting it if TLS
+ * is running. Returns the number of bytes sent or -1 on failure.
+ *****************************************************************/
+ssize_t tlsSend(int socket, const void *buffer, size_t length) {
+    SSL *ssl = findSession(socket);
+    int sentBytes;
+
+    if(ssl == NULL) {
+        return send(socket, buffer, length, 0);
+    }
+    if((sentBytes = SSL_write(ssl, buffer, length)) <= 0) {
+        ERR_clear_error();
+        return -1;
+    }
+    return sentBytes;
+}
+
+/*****************************************************************
+ * Name: tlsRecv
+ * Preconditions:
+ * @param socket - connected socket to the client
+ * @param buffer - where the received bytes are stored
+ * @param length - size of buffer
+ * Postconditions: Receives from socket, decrypting if TLS is
+ * running. Returns the number of bytes received, 0 if the client
+ * closed the connection or -1 on failure.
+ *****************************************************************/
+ssize_t tlsRecv(int socket, void *buffer, size_t length) {
+    SSL *ssl = findSession(socket);
+    int receivedBytes;
+
+    if(ssl == NULL) {
+        return recv(socket, buffer, length, 0);
+    }
+    if((receivedBytes = SSL_read(ssl, buffer, length)) <= 0) {
+        receivedBytes = SSL_get_error(ssl, receivedBytes) == SSL_ERROR_ZERO_RETURN ? 0 : -1;
+        ERR_clear_error();
+    }
+    return receivedBytes;
+}
+
+/*****************************************************************
+ * Name: tlsSendFile
+ * Preconditions:
+ * @param socket - connected socket to the client
+ * @param fd - open file to be sent
+ * @param size - number of bytes in the file
+ * Postconditions: Sends the whole file over socket. Plaintext and
+ * kTLS connections use sendfile, so the file never passes through
+ * user space. Without kTLS the file is read and encrypted by
+ * OpenSSL one record at a time. Returns -1 on failure.
+ * Source: https://www.openssl.org/docs/man3.0/man3/SSL_sendfile.html
+ *****************************************************************/
+int tlsSendFile(int socket, int fd, size_t size) {
+    SSL *ssl = findSession(socket);
+    off_t offset = 0;
+    ssize_t sentBytes;
+    char buffer[TLS_BUFFER_SIZE];
+
+    // Plaintext - the kernel copies straight from the page cache
+    if(ssl == NULL) {
+        while((size_t)offset < size) {
+            if((sentBytes = sendfile(socket, fd, &offset, size - offset)) <= 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    // kTLS - the kernel encrypts as it copies from the page cache
+    if(BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+        while((size_t)offset < size) {
+            if((sentBytes = SSL_sendfile(ssl, fd, offset, size - offset, 0)) <= 0) {
+                ERR_clear_error();
+                return -1;
+            }
+            offset += sentBytes;
+        }
+        return 0;
+    }
+
+    // No kTLS for this connection - encrypt in user space
+    while((sentBytes = read(fd, buffer, sizeof(buffer))) > 0) {
+        if(SSL_write(ssl, buffer, sentBytes) <= 0) {
+            ERR_clear_error();
+            return -1;
+        }
+    }
+    return sentBytes == -1 ? -1 : 0;
+}
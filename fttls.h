@@ -0,0 +1,28 @@
+/*****************************************************************
+ * Name: Chelsea Egan
+ * Course: CS 372-400
+ * Program: fttls.h
+ * Description: This file provides the declaration of functions
+ * used by fttls.c
+ * Last Modified: October 19, 2026
+*****************************************************************/
+
+#ifndef PROJECT_2_FTTLS_H
+#define PROJECT_2_FTTLS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define TLS_CERT_ENV "FTSERVER_TLS_CERT"    // Certificate chain (PEM) - enables TLS
+#define TLS_KEY_ENV "FTSERVER_TLS_KEY"      // Private key (PEM) for the certificate
+#define TLS_BUFFER_SIZE 16384               // One TLS record, used when kTLS is unavailable
+
+void initTls(int[]);
+int startTls(int);
+void endTls(int);
+bool tlsOffloaded(int);
+ssize_t tlsSend(int, const void *, size_t);
+ssize_t tlsRecv(int, void *, size_t);
+int tlsSendFile(int, int, size_t);
+
+#endif //PROJECT_2_FTTLS_H
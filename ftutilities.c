@@ -4,7 +4,7 @@
  * Program: ftutilities.c
  * Description: This file provides the initialization of functions
  * used by ftserver.c
- * Last Modified: June 2, 2019
+ * Last Modified: October 19, 2026
 *****************************************************************/
 
 #include <arpa/inet.h>
@@ -23,6 +23,9 @@
 #include <unistd.h>
 
 #include "ftutilities.h"
+#include "fthandoff.h"
+#include "ftsnapshot.h"
+#include "fttls.h"
 
 /*****************************************************************
  * name: startUp
@@ -31,15 +34,33 @@
  * @param port - port number provided on command line
  * @param sockets - array of sockets used by program
  * Postconditions: Validates number of args provided and the port
- * number then creates a welcoming socket.
+ * number then creates a welcoming socket, unless one was handed
+ * over by the server this one is replacing. Then sets up TLS and
+ * loads the saved snapshot of the directory. The server being
+ * replaced is only told to exit once all of this has succeeded.
  *****************************************************************/
 void startUp(int argNum, char *port, int sockets[]) {
     // Set the port of the server to the one selected if valid
     validateCommandLineArguments(argNum, sockets);
     char* controlPort = validatePortNumber(port, sockets);
 
-    // Create a socket to listen for connection requests
-    createSocket(controlPort, sockets);
+    // Hot upgrade - keep listening on the old server's socket
+    if(receiveHandoff(sockets) == 0) {
+        signal(SIGCHLD, SIG_IGN);
+        printf("Port: %s\n", controlPort);
+    } else {
+        // Create a socket to listen for connection requests
+        createSocket(controlPort, sockets);
+    }
+
+    // Encrypt connections if a certificate was provided
+    initTls(sockets);
+
+    // Reuse the last directory scan instead of rescanning
+    loadSnapshot();
+
+    // Startup succeeded - the server being replaced can exit
+    confirmHandoff(sockets);
 }
 
 /*****************************************************************
@@ -198,6 +219,12 @@ int initDataConnection(char *hostname, char *port, int sockets[]) {
     }
 
     freeaddrinfo(servInfo);
+
+    // Encrypt the data connection as well if TLS is enabled
+    if(startTls(sockets[DATA_SOCKET]) == -1) {
+        closeConnection("TLS handshake failed on data connection", sockets);
+        return -1;
+    }
     return 0;
 }
 
@@ -249,6 +276,12 @@ void handleRequests(int sockets[], char *clientHostName) {
     char dataPort[MAXBUFFERSIZE + 1];
     char fileName[MAXBUFFERSIZE + 1];
 
+    // Encrypt the control connection if TLS is enabled
+    if(startTls(sockets[CONTROL_SOCKET]) == -1) {
+        closeConnection("TLS handshake failed on control connection", sockets);
+        return;
+    }
+
     // Get the command from the client from the control socket
     // failure: go to beginning of while loop
     command = receiveCommand(&sockets[CONTROL_SOCKET]);
@@ -309,8 +342,7 @@ void handleRequests(int sockets[], char *clientHostName) {
     }
 
     // Close control and data sockets
-    close(sockets[CONTROL_SOCKET]);
-    close(sockets[DATA_SOCKET]);
+    closeSockets(&sockets[CONTROL_SOCKET], 2);
 }
 
 /*****************************************************************
@@ -330,24 +362,24 @@ int receiveCommand(int *socket) {
 
     // If command doesn't start with '-' it must be invalid
     if(command[0] != '-') {
-        send(*socket, REJECTION, strlen(REJECTION), 0);
+        tlsSend(*socket, REJECTION, strlen(REJECTION));
         return -1;
     }
 
     // Check if a recognized command and send confirmation/rejection to client
     switch(command[1]) {
         case 'l':
-            if(send(*socket, CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+            if(tlsSend(*socket, CONFIRMATION, strlen(CONFIRMATION)) == -1) {
                 return -1;
             }
             return LIST_COMMAND;
         case 'g':
-            if(send(*socket, CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+            if(tlsSend(*socket, CONFIRMATION, strlen(CONFIRMATION)) == -1) {
                 return -1;
             }
             return FILE_COMMAND;
         default:
-            if(send(*socket, REJECTION, strlen(REJECTION), 0) == -1) {
+            if(tlsSend(*socket, REJECTION, strlen(REJECTION)) == -1) {
                 return -1;
             }
             return -1;
@@ -370,10 +402,10 @@ int receiveDataPort(int *socket, char *port) {
 
     // Check if in a valid range of port number
     if(atoi(port) < 1024 || atoi(port) > 65535) {
-        send(*socket, REJECTION, strlen(REJECTION), 0);
+        tlsSend(*socket, REJECTION, strlen(REJECTION));
         return -1;
     } else {
-        if(send(*socket, CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+        if(tlsSend(*socket, CONFIRMATION, strlen(CONFIRMATION)) == -1) {
             return -1;
         }
         return 0;
@@ -395,7 +427,7 @@ int receiveFileName(int *socket, char *buffer) {
     }
 
     // Send confirmation to client
-    if(send(*socket, CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+    if(tlsSend(*socket, CONFIRMATION, strlen(CONFIRMATION)) == -1) {
         return -1;
     }
     return 0;
@@ -413,7 +445,7 @@ int receiveMessage(int *socket, char *buffer) {
     int numBytes;
 
     // Put bytes into buffer
-    if ((numBytes = recv(*socket, buffer, MAXBUFFERSIZE, 0)) == -1) {
+    if ((numBytes = tlsRecv(*socket, buffer, MAXBUFFERSIZE)) == -1) {
         return -1;
     }
 
@@ -427,25 +459,23 @@ int receiveMessage(int *socket, char *buffer) {
  * Preconditions:
  * @param fileName - pointer to char array holding filename
  * Postconditions: Checks if the directory has a file with the
- * requested name and returns true/false.
- * Source for looping through directory: https://stackoverflow.com/a/22623744
+ * requested name and returns true/false. Names containing a '/'
+ * (or "." and "..") are always rejected, so nothing outside the
+ * directory can be sent.
  *****************************************************************/
 bool validateFileName(char *fileName) {
-    DIR *directory;
-    struct dirent *dirPtr;
-
-    // Open local directory
-    if((directory = opendir(".")) == NULL) {
+    // Only plain names in the served directory may be requested
+    if(fileName[0] == '\0' || strchr(fileName, '/') != NULL
+       || strcmp(fileName, ".") == 0 || strcmp(fileName, "..") == 0) {
         return false;
     }
 
-    // Loop through directory and compare filenames
-    while((dirPtr = readdir(directory)) != NULL) {
-        if (strcmp(fileName, dirPtr->d_name) == 0) {
-            return true;
-        }
+    // Bring the directory snapshot up to date if needed
+    if(refreshSnapshot() == -1) {
+        return false;
     }
-    return false;
+
+    return snapshotContains(fileName);
 }
 
 /*****************************************************************
@@ -455,23 +485,21 @@ bool validateFileName(char *fileName) {
  * @param fileName - pointer to char array holding filename
  * Postconditions: Checks if the requested filename exists in the
  * directory. If it does, sends file to client over data connection
+ * with sendfile (encrypted by the kernel when kTLS is active).
  * References:
  * https://stackoverflow.com/questions/30440188/sending-files-from-client-to-server-using-sockets-in-c
  * https://stackoverflow.com/questions/11952898/c-send-and-receive-file
  * https://stackoverflow.com/questions/2014033/send-and-receive-a-file-in-socket-programming-in-linux-with-c-c-gcc-g
  *****************************************************************/
 int sendFile(int sockets[], char *fileName) {
-    int sentBytes;
+    int sendingFile;
     struct stat fileStats;
-    char fileSize[256];
-    char sendBuffer[2048];
-    FILE *sendingFile;
-    char clientGoAhead[256];
+    char clientGoAhead[MAXBUFFERSIZE + 1];
 
     // Check if filename exists in directory
     if(validateFileName(fileName)) {
         // Send confirmation to client
-        if(send(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+        if(tlsSend(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION)) == -1) {
             closeConnection("Failed to send confirmation to client", sockets);
             return -1;
         }
@@ -488,34 +516,42 @@ int sendFile(int sockets[], char *fileName) {
     }
     if (strcmp(clientGoAhead, CONFIRMATION) == 0) {
         // Open the requested file
-        if((sendingFile = fopen(fileName, "r")) == NULL){
+        if((sendingFile = open(fileName, O_RDONLY)) == -1) {
+            closeConnection("Failed to open file", sockets);
+            return -1;
+        }
+        if(fstat(sendingFile, &fileStats) == -1) {
+            close(sendingFile);
             closeConnection("Failed to open file", sockets);
             return -1;
         }
 
-        // Read the file and send over data connection
-        while((sentBytes = fread(sendBuffer, 1, sizeof(sendBuffer), sendingFile)) > 0) {
-            if(send(sockets[DATA_SOCKET], sendBuffer, strlen(sendBuffer), 0) == -1) {
-                closeConnection("Failed to send file to client", sockets);
-                return -1;
-            }
-            memset(sendBuffer, 0, sizeof(sendBuffer));
+        // Send the file over data connection without copying it through a buffer
+        if(tlsOffloaded(sockets[DATA_SOCKET])) {
+            printf("Sending with kernel TLS\n");
+        }
+        if(tlsSendFile(sockets[DATA_SOCKET], sendingFile, fileStats.st_size) == -1) {
+            close(sendingFile);
+            closeConnection("Failed to send file to client", sockets);
+            return -1;
         }
 
         // Send ACK to confirm end of file
-        if(send(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+        if(tlsSend(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION)) == -1) {
             closeConnection("Failed to send confirmation to client", sockets);
             return -1;
         }
 
-        fclose(sendingFile);
+        close(sendingFile);
         printf("File transfer complete\n");
     } else {
         // Inform client that file does not exist and close connection
-        send(sockets[DATA_SOCKET], REJECTION, strlen(REJECTION), 0);
+        tlsSend(sockets[DATA_SOCKET], REJECTION, strlen(REJECTION));
         closeConnection("Invalid filename received from client", sockets);
         return -1;
     }
+
+    return 0;
 }
 
 /*****************************************************************
@@ -523,7 +559,7 @@ int sendFile(int sockets[], char *fileName) {
  * Preconditions:
  * @param sockets - array of sockets used by program
  * Postconditions: Sends a list of files stored in the current
- * directory to the client.
+ * directory to the client, read from the directory snapshot.
  * References:
  * https://www.geeksforgeeks.org/c-program-list-files-sub-directories-directory/
  * http://pubs.opengroup.org/onlinepubs/009695399/functions/opendir.html
@@ -531,13 +567,13 @@ int sendFile(int sockets[], char *fileName) {
  * https://www.ibm.com/support/knowledgecenter/en/SSLTBW_2.3.0/com.ibm.zos.v2r3.bpxbd00/rtgtc.htm
  *****************************************************************/
 int sendDirectory(int sockets[]) {
-    DIR *directory;
-    struct dirent *dirPtr;
+    uint32_t i;
+    const char *name;
     char cwd[MAXBUFFERSIZE];
-    char message[MAXBUFFERSIZE];
+    char message[MAXBUFFERSIZE + 1];
 
-    // Open local directory
-    if((directory = opendir(".")) == NULL) {
+    // Bring the directory snapshot up to date if needed
+    if(refreshSnapshot() == -1) {
         closeConnection("Failed to open directory", sockets);
         return -1;
     }
@@ -546,26 +582,29 @@ int sendDirectory(int sockets[]) {
     strncat(cwd, "\n", 2);
 
     // Send the name of the current directory to the client
-    if(send(sockets[DATA_SOCKET], cwd, strlen(cwd), 0) == -1) {
+    if(tlsSend(sockets[DATA_SOCKET], cwd, strlen(cwd)) == -1) {
         closeConnection("Failed to send directory name", sockets);
         return -1;
     }
 
-    // Iterate over the directory and send the filename over the data connection
-    while((dirPtr = readdir(directory)) != NULL) {
-        strncpy(message, dirPtr->d_name, sizeof(dirPtr->d_name));
-        strncat(message, "\n", 2);
-        if(send(sockets[DATA_SOCKET], message, strlen(message), 0) == -1) {
+    // Iterate over the snapshot and send the filename over the data connection
+    for(i = 0; i < snapshotEntryCount(); i++) {
+        if((name = snapshotEntryName(i)) == NULL) {
+            continue;
+        }
+        snprintf(message, sizeof(message), "%s\n", name);
+        if(tlsSend(sockets[DATA_SOCKET], message, strlen(message)) == -1) {
             closeConnection("Failed to send directory", sockets);
             return -1;
         }
     }
 
     // Send 'ACK' to confirm all files have been sent
-    if(send(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION), 0) == -1) {
+    if(tlsSend(sockets[DATA_SOCKET], CONFIRMATION, strlen(CONFIRMATION)) == -1) {
         closeConnection("Failed to send confirmation to client", sockets);
         return -1;
     }
+    return 0;
 }
 
 /*****************************************************************
@@ -612,12 +651,14 @@ void closeConnection(char *errorMessage, int sockets[]) {
  * Preconditions:
  * @param sockets - array of sockets to be closed
  * @param numSockets - number of sockets to be closed
- * Postconditions: Closes provided sockets
+ * Postconditions: Ends any TLS session on the provided sockets and
+ * closes them
  *****************************************************************/
 void closeSockets(int sockets[], int numSockets) {
     int i = 0;
 
     for(i; i < numSockets; i++) {
+        endTls(sockets[i]);
         close(sockets[i]);
     }
 }